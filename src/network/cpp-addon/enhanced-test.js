@@ -1,3 +1,4 @@
+const assert = require('assert');
 const NetworkSimulation = require('./index').NetworkSimulation;
 
 // Create a new simulation
@@ -27,6 +28,50 @@ console.log("Router info:", simulation.getNodeInfo(router));
 console.log("Client 1 info:", simulation.getNodeInfo(client1));
 console.log("Client 2 info:", simulation.getNodeInfo(client2));
 
+// Bulk export of node state as typed arrays
+console.log("\nExporting network state...");
+const printer = simulation.addNode("printer-1", "printer", "printer.local");
+simulation.connectNodes(client1, router);
+simulation.connectNodes(router, server);
+const snapshot = simulation.exportState();
+console.log(`Exported ${snapshot.count} of ${snapshot.totalNodes} nodes at version ${snapshot.version}`);
+const decoder = new TextDecoder();
+const exportedIds = [];
+for (let row = 0; row < snapshot.count; row++) {
+  const id = decoder.decode(snapshot.idBytes.subarray(snapshot.idOffsets[row], snapshot.idOffsets[row + 1]));
+  const active = (snapshot.active[row >> 3] >> (row & 7)) & 1;
+  const links = snapshot.linkTargets.subarray(snapshot.linkOffsets[row], snapshot.linkOffsets[row + 1]);
+  console.log(`  ${id}: type=${snapshot.typeNames[snapshot.types[row]]} active=${!!active} links=[${links}]`);
+  exportedIds.push(id);
+}
+
+assert.strictEqual(snapshot.version, simulation.getVersion());
+assert.strictEqual(snapshot.count, 5);
+assert.strictEqual(snapshot.totalNodes, 5);
+assert.deepStrictEqual(Array.from(snapshot.indices), [server, router, client1, client2, printer]);
+assert.deepStrictEqual(exportedIds, ["server-1", "router-1", "client-1", "client-2", "printer-1"]);
+assert.deepStrictEqual(snapshot.typeNames, ["server", "router", "client", "printer"]);
+assert.deepStrictEqual(Array.from(snapshot.types), [0, 1, 2, 2, 3]);
+assert.deepStrictEqual(Array.from(snapshot.ipv4), [0xC0A80101, 0xC0A801FE, 0xC0A80164, 0xC0A80165, 0]);
+assert.deepStrictEqual(Array.from(snapshot.active), [0b01111]);
+assert.deepStrictEqual(Array.from(snapshot.linkOffsets), [0, 0, 1, 2, 2, 2]);
+assert.deepStrictEqual(Array.from(snapshot.linkTargets), [server, router]);
+
+// Only nodes changed since the previous export
+simulation.deactivateNode(client2);
+const delta = simulation.exportState({ since: snapshot.version });
+console.log(`Changed since version ${snapshot.version}: ${delta.count} node(s)`);
+
+assert.strictEqual(delta.count, 1);
+assert.deepStrictEqual(Array.from(delta.indices), [client2]);
+assert.strictEqual(decoder.decode(delta.idBytes), "client-2");
+assert.deepStrictEqual(Array.from(delta.active), [0]);
+assert.throws(() => simulation.exportState({ since: snapshot.version, active: true }), TypeError);
+// Options set to undefined are ignored, as on a first refresh with no snapshot yet
+const first = simulation.exportState({ since: undefined, type: undefined, active: undefined });
+assert.strictEqual(first.since, 0);
+assert.strictEqual(first.count, 5);
+
 // Send data
 console.log("\nSending data from client to server...");
 const message = "GET /api/data";
@@ -56,4 +101,34 @@ console.log("Server active status:", simulation.getNodeInfo(server).active);
 const retry = simulation.sendData(client1, server, "GET /api/status");
 console.log("Data sent successfully:", retry);
 
+// Profile a few calls
+console.log("\nProfiling sendData and exportState...");
+simulation.resetProfile();
+simulation.enableProfiling();
+for (let i = 0; i < 3; i++) {
+  simulation.sendData(client1, server, "GET /api/status");
+}
+simulation.exportState();
+const profile = simulation.getProfile();
+simulation.enableProfiling(false);
+
+const phases = {};
+for (const phase of profile.phases) {
+  console.log(`  ${phase.name}: ${phase.calls} calls, ${(phase.selfNs / 1e3).toFixed(1)}us self`);
+  phases[phase.name] = phase;
+}
+assert.strictEqual(profile.enabled, true);
+assert.strictEqual(phases.napi.calls, 4);
+assert.strictEqual(phases.execute.calls, 3);
+assert.strictEqual(phases.export.calls, 1);
+// execute and export are nested in napi and come out of its self time
+assert.strictEqual(phases.napi.selfNs + phases.execute.totalNs + phases.export.totalNs, phases.napi.totalNs);
+assert.strictEqual(phases.execute.selfNs, phases.execute.totalNs);
+// Allocation counts only exist in the standalone executables
+for (const phase of profile.phases) {
+  assert.ok(!('allocations' in phase) && !('allocatedBytes' in phase));
+}
+simulation.resetProfile();
+assert.deepStrictEqual(simulation.getProfile().phases, []);
+
 console.log("\nNetwork simulation demo completed.");
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include <vector>
 #include <memory>
 #include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "../cpp-common/network_profile.h"
 
 // Error handling helper
 class NetworkError : public std::runtime_error {
@@ -19,8 +24,14 @@ public:
     bool active;
     std::vector<std::string> connections;
 
+    // Export-side state: dictionary code for type, packed IPv4 (0 if not
+    // dotted-quad) and the simulation version of the last change.
+    uint32_t typeCode;
+    uint32_t ipv4;
+    uint64_t version;
+
     NetworkNode(std::string id, std::string type, std::string ip)
-        : id(id), type(type), ip(ip), active(false) {}
+        : id(id), type(type), ip(ip), active(false), typeCode(0), ipv4(0), version(0) {}
 
     void activate() {
         active = true;
@@ -59,21 +70,95 @@ public:
     }
 };
 
+// Parse a dotted-quad IPv4 string into host byte order, 0 if malformed
+static uint32_t parseIPv4(const std::string& ip) {
+    uint32_t result = 0;
+    uint32_t octet = 0;
+    int digits = 0;
+    int parts = 0;
+
+    for (char c : ip) {
+        if (c >= '0' && c <= '9') {
+            octet = octet * 10 + (c - '0');
+            if (++digits > 3 || octet > 255) return 0;
+        } else if (c == '.') {
+            if (digits == 0 || ++parts > 3) return 0;
+            result = (result << 8) | octet;
+            octet = 0;
+            digits = 0;
+        } else {
+            return 0;
+        }
+    }
+
+    if (digits == 0 || parts != 3) return 0;
+    return (result << 8) | octet;
+}
+
+// Selection for a bulk export. since == 0 exports everything; otherwise only
+// nodes changed after that version are included.
+struct ExportFilter {
+    uint64_t since = 0;
+    bool filterType = false;
+    std::string type;
+    bool filterActive = false;
+    bool active = false;
+    bool includeLinks = true;
+};
+
+// Columnar snapshot of the selected nodes. Row i describes node indices[i];
+// ids are stored as UTF-8 bytes addressed by idOffsets[i]..idOffsets[i + 1],
+// activation is a little-endian bitset over rows and links are CSR rows of
+// target node indices.
+struct NodeExport {
+    uint64_t version = 0;
+    uint32_t totalNodes = 0;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> idOffsets;
+    std::vector<uint8_t> idBytes;
+    std::vector<uint32_t> typeCodes;
+    std::vector<uint32_t> ipv4;
+    std::vector<uint8_t> activeBits;
+    std::vector<uint32_t> linkOffsets;
+    std::vector<uint32_t> linkTargets;
+};
+
 class NetworkSimulation {
 private:
     std::vector<std::shared_ptr<NetworkNode>> nodes;
+    std::unordered_map<std::string, int> indexById;
+    std::vector<std::string> typeNames;
+    std::unordered_map<std::string, uint32_t> typeCodes;
+    uint64_t version = 0;
+
+    void touch(NetworkNode& node) {
+        node.version = ++version;
+    }
 
 public:
     NetworkSimulation() {}
 
     int addNode(const std::string& id, const std::string& type, const std::string& ip) {
-        nodes.push_back(std::make_shared<NetworkNode>(id, type, ip));
+        auto node = std::make_shared<NetworkNode>(id, type, ip);
+
+        auto code = typeCodes.find(type);
+        if (code == typeCodes.end()) {
+            code = typeCodes.emplace(type, static_cast<uint32_t>(typeNames.size())).first;
+            typeNames.push_back(type);
+        }
+        node->typeCode = code->second;
+        node->ipv4 = parseIPv4(ip);
+        touch(*node);
+
+        nodes.push_back(node);
+        indexById[id] = nodes.size() - 1;
         return nodes.size() - 1;
     }
 
     bool activateNode(int index) {
         if (index >= 0 && index < nodes.size()) {
             nodes[index]->activate();
+            touch(*nodes[index]);
             return true;
         }
         return false;
@@ -82,6 +167,17 @@ public:
     bool deactivateNode(int index) {
         if (index >= 0 && index < nodes.size()) {
             nodes[index]->deactivate();
+            touch(*nodes[index]);
+            return true;
+        }
+        return false;
+    }
+
+    bool connectNodes(int sourceIndex, int targetIndex) {
+        if (sourceIndex >= 0 && sourceIndex < static_cast<int>(nodes.size()) &&
+            targetIndex >= 0 && targetIndex < static_cast<int>(nodes.size())) {
+            nodes[sourceIndex]->addConnection(nodes[targetIndex]->id);
+            touch(*nodes[sourceIndex]);
             return true;
         }
         return false;
@@ -107,8 +203,91 @@ public:
         
         return result;
     }
+
+    uint64_t getVersion() const {
+        return version;
+    }
+
+    const std::vector<std::string>& getTypeNames() const {
+        return typeNames;
+    }
+
+    NodeExport exportNodes(const ExportFilter& filter) const {
+        NodeExport out;
+        out.version = version;
+        out.totalNodes = nodes.size();
+
+        bool filterTypeKnown = false;
+        uint32_t filterTypeCode = 0;
+        if (filter.filterType) {
+            auto code = typeCodes.find(filter.type);
+            if (code == typeCodes.end()) {
+                out.idOffsets.push_back(0);
+                out.linkOffsets.push_back(0);
+                return out;
+            }
+            filterTypeKnown = true;
+            filterTypeCode = code->second;
+        }
+
+        out.indices.reserve(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const NetworkNode& node = *nodes[i];
+            if (node.version <= filter.since) continue;
+            if (filterTypeKnown && node.typeCode != filterTypeCode) continue;
+            if (filter.filterActive && node.active != filter.active) continue;
+            out.indices.push_back(i);
+        }
+
+        size_t rows = out.indices.size();
+        size_t idBytes = 0;
+        for (uint32_t i : out.indices) idBytes += nodes[i]->id.size();
+
+        out.idOffsets.reserve(rows + 1);
+        out.idBytes.reserve(idBytes);
+        out.typeCodes.reserve(rows);
+        out.ipv4.reserve(rows);
+        out.activeBits.assign((rows + 7) / 8, 0);
+        out.idOffsets.push_back(0);
+
+        for (size_t row = 0; row < rows; ++row) {
+            const NetworkNode& node = *nodes[out.indices[row]];
+            out.idBytes.insert(out.idBytes.end(), node.id.begin(), node.id.end());
+            out.idOffsets.push_back(out.idBytes.size());
+            out.typeCodes.push_back(node.typeCode);
+            out.ipv4.push_back(node.ipv4);
+            if (node.active) out.activeBits[row >> 3] |= 1u << (row & 7);
+        }
+
+        out.linkOffsets.reserve(rows + 1);
+        out.linkOffsets.push_back(0);
+        if (filter.includeLinks) {
+            for (uint32_t i : out.indices) {
+                for (const auto& conn : nodes[i]->connections) {
+                    auto target = indexById.find(conn);
+                    if (target != indexById.end()) {
+                        out.linkTargets.push_back(target->second);
+                    }
+                }
+                out.linkOffsets.push_back(out.linkTargets.size());
+            }
+        } else {
+            out.linkOffsets.resize(rows + 1, 0);
+        }
+
+        return out;
+    }
 };
 
+template <typename TypedArray, typename T>
+static TypedArray copyToTypedArray(Napi::Env env, const std::vector<T>& values) {
+    TypedArray array = TypedArray::New(env, values.size());
+    if (!values.empty()) {
+        std::memcpy(array.Data(), values.data(), values.size() * sizeof(T));
+    }
+    return array;
+}
+
 // Wrapper class for NetworkSimulation
 class NetworkSimulationWrapper : public Napi::ObjectWrap<NetworkSimulationWrapper> {
 public:
@@ -124,6 +303,12 @@ private:
     Napi::Value DeactivateNode(const Napi::CallbackInfo& info);
     Napi::Value SendData(const Napi::CallbackInfo& info);
     Napi::Value GetNodeInfo(const Napi::CallbackInfo& info);
+    Napi::Value ConnectNodes(const Napi::CallbackInfo& info);
+    Napi::Value GetVersion(const Napi::CallbackInfo& info);
+    Napi::Value ExportState(const Napi::CallbackInfo& info);
+    Napi::Value EnableProfiling(const Napi::CallbackInfo& info);
+    Napi::Value GetProfile(const Napi::CallbackInfo& info);
+    Napi::Value ResetProfile(const Napi::CallbackInfo& info);
 };
 
 Napi::FunctionReference NetworkSimulationWrapper::constructor;
@@ -136,7 +321,13 @@ Napi::Object NetworkSimulationWrapper::Init(Napi::Env env, Napi::Object exports)
         InstanceMethod("activateNode", &NetworkSimulationWrapper::ActivateNode),
         InstanceMethod("deactivateNode", &NetworkSimulationWrapper::DeactivateNode),
         InstanceMethod("sendData", &NetworkSimulationWrapper::SendData),
-        InstanceMethod("getNodeInfo", &NetworkSimulationWrapper::GetNodeInfo)
+        InstanceMethod("getNodeInfo", &NetworkSimulationWrapper::GetNodeInfo),
+        InstanceMethod("connectNodes", &NetworkSimulationWrapper::ConnectNodes),
+        InstanceMethod("getVersion", &NetworkSimulationWrapper::GetVersion),
+        InstanceMethod("exportState", &NetworkSimulationWrapper::ExportState),
+        InstanceMethod("enableProfiling", &NetworkSimulationWrapper::EnableProfiling),
+        InstanceMethod("getProfile", &NetworkSimulationWrapper::GetProfile),
+        InstanceMethod("resetProfile", &NetworkSimulationWrapper::ResetProfile)
     });
 
     constructor = Napi::Persistent(func);
@@ -153,6 +344,7 @@ NetworkSimulationWrapper::NetworkSimulationWrapper(const Napi::CallbackInfo& inf
 }
 
 Napi::Value NetworkSimulationWrapper::AddNode(const Napi::CallbackInfo& info) {
+    NETSIM_PROFILE_SCOPE("napi");
     Napi::Env env = info.Env();
     
     if (info.Length() < 3) {
@@ -164,11 +356,16 @@ Napi::Value NetworkSimulationWrapper::AddNode(const Napi::CallbackInfo& info) {
     std::string type = info[1].As<Napi::String>();
     std::string ip = info[2].As<Napi::String>();
 
-    int index = simulation.addNode(id, type, ip);
+    int index;
+    {
+        NETSIM_PROFILE_SCOPE("execute");
+        index = simulation.addNode(id, type, ip);
+    }
     return Napi::Number::New(env, index);
 }
 
 Napi::Value NetworkSimulationWrapper::ActivateNode(const Napi::CallbackInfo& info) {
+    NETSIM_PROFILE_SCOPE("napi");
     Napi::Env env = info.Env();
     
     if (info.Length() < 1) {
@@ -177,12 +374,17 @@ Napi::Value NetworkSimulationWrapper::ActivateNode(const Napi::CallbackInfo& inf
     }
 
     int index = info[0].As<Napi::Number>().Int32Value();
-    bool success = simulation.activateNode(index);
+    bool success;
+    {
+        NETSIM_PROFILE_SCOPE("execute");
+        success = simulation.activateNode(index);
+    }
     
     return Napi::Boolean::New(env, success);
 }
 
 Napi::Value NetworkSimulationWrapper::DeactivateNode(const Napi::CallbackInfo& info) {
+    NETSIM_PROFILE_SCOPE("napi");
     Napi::Env env = info.Env();
     
     if (info.Length() < 1) {
@@ -191,12 +393,17 @@ Napi::Value NetworkSimulationWrapper::DeactivateNode(const Napi::CallbackInfo& i
     }
 
     int index = info[0].As<Napi::Number>().Int32Value();
-    bool success = simulation.deactivateNode(index);
+    bool success;
+    {
+        NETSIM_PROFILE_SCOPE("execute");
+        success = simulation.deactivateNode(index);
+    }
     
     return Napi::Boolean::New(env, success);
 }
 
 Napi::Value NetworkSimulationWrapper::SendData(const Napi::CallbackInfo& info) {
+    NETSIM_PROFILE_SCOPE("napi");
     Napi::Env env = info.Env();
     
     if (info.Length() < 3) {
@@ -208,12 +415,17 @@ Napi::Value NetworkSimulationWrapper::SendData(const Napi::CallbackInfo& info) {
     int targetIndex = info[1].As<Napi::Number>().Int32Value();
     std::string data = info[2].As<Napi::String>();
 
-    bool success = simulation.sendData(sourceIndex, targetIndex, data);
+    bool success;
+    {
+        NETSIM_PROFILE_SCOPE("execute");
+        success = simulation.sendData(sourceIndex, targetIndex, data);
+    }
     
     return Napi::Boolean::New(env, success);
 }
 
 Napi::Value NetworkSimulationWrapper::GetNodeInfo(const Napi::CallbackInfo& info) {
+    NETSIM_PROFILE_SCOPE("napi");
     Napi::Env env = info.Env();
     
     if (info.Length() < 1) {
@@ -225,8 +437,153 @@ Napi::Value NetworkSimulationWrapper::GetNodeInfo(const Napi::CallbackInfo& info
     return simulation.getNodeInfo(index, env);
 }
 
+Napi::Value NetworkSimulationWrapper::ConnectNodes(const Napi::CallbackInfo& info) {
+    NETSIM_PROFILE_SCOPE("napi");
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 2) {
+        Napi::TypeError::New(env, "Wrong number of arguments").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    int sourceIndex = info[0].As<Napi::Number>().Int32Value();
+    int targetIndex = info[1].As<Napi::Number>().Int32Value();
+
+    bool success;
+    {
+        NETSIM_PROFILE_SCOPE("execute");
+        success = simulation.connectNodes(sourceIndex, targetIndex);
+    }
+    
+    return Napi::Boolean::New(env, success);
+}
+
+Napi::Value NetworkSimulationWrapper::GetVersion(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(simulation.getVersion()));
+}
+
+// exportState([options]) returns the node and link state as typed arrays
+// instead of one object per node. Options: since (version), type, active,
+// links (default true).
+Napi::Value NetworkSimulationWrapper::ExportState(const Napi::CallbackInfo& info) {
+    NETSIM_PROFILE_SCOPE("napi");
+    Napi::Env env = info.Env();
+    ExportFilter filter;
+
+    if (info.Length() >= 1 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+
+        // An option explicitly set to undefined counts as not set, so callers
+        // can pass { since: last?.version } on the first export
+        Napi::Value since = options.Get("since");
+        if (!since.IsUndefined()) {
+            if (!since.IsNumber()) {
+                Napi::TypeError::New(env, "since must be a number").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            double value = since.As<Napi::Number>().DoubleValue();
+            filter.since = value > 0 ? static_cast<uint64_t>(value) : 0;
+        }
+        Napi::Value type = options.Get("type");
+        if (!type.IsUndefined()) {
+            if (!type.IsString()) {
+                Napi::TypeError::New(env, "type must be a string").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            filter.filterType = true;
+            filter.type = type.As<Napi::String>();
+        }
+        Napi::Value active = options.Get("active");
+        if (!active.IsUndefined()) {
+            // A node leaving the filtered set would silently vanish from the
+            // delta, so a since export must carry every changed row
+            if (filter.since > 0) {
+                Napi::TypeError::New(env, "active cannot be combined with since").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            filter.filterActive = true;
+            filter.active = active.ToBoolean();
+        }
+        Napi::Value links = options.Get("links");
+        if (!links.IsUndefined()) {
+            filter.includeLinks = links.ToBoolean();
+        }
+    }
+
+    NodeExport snapshot;
+    {
+        NETSIM_PROFILE_SCOPE("export");
+        snapshot = simulation.exportNodes(filter);
+    }
+
+    Napi::Array typeNames = Napi::Array::New(env, simulation.getTypeNames().size());
+    for (size_t i = 0; i < simulation.getTypeNames().size(); ++i) {
+        typeNames.Set(static_cast<uint32_t>(i), simulation.getTypeNames()[i]);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("version", Napi::Number::New(env, static_cast<double>(snapshot.version)));
+    result.Set("since", Napi::Number::New(env, static_cast<double>(filter.since)));
+    result.Set("totalNodes", Napi::Number::New(env, snapshot.totalNodes));
+    result.Set("count", Napi::Number::New(env, snapshot.indices.size()));
+    result.Set("typeNames", typeNames);
+    result.Set("indices", copyToTypedArray<Napi::Uint32Array>(env, snapshot.indices));
+    result.Set("idOffsets", copyToTypedArray<Napi::Uint32Array>(env, snapshot.idOffsets));
+    result.Set("idBytes", copyToTypedArray<Napi::Uint8Array>(env, snapshot.idBytes));
+    result.Set("types", copyToTypedArray<Napi::Uint32Array>(env, snapshot.typeCodes));
+    result.Set("ipv4", copyToTypedArray<Napi::Uint32Array>(env, snapshot.ipv4));
+    result.Set("active", copyToTypedArray<Napi::Uint8Array>(env, snapshot.activeBits));
+    result.Set("linkOffsets", copyToTypedArray<Napi::Uint32Array>(env, snapshot.linkOffsets));
+    result.Set("linkTargets", copyToTypedArray<Napi::Uint32Array>(env, snapshot.linkTargets));
+
+    return result;
+}
+
+Napi::Value NetworkSimulationWrapper::EnableProfiling(const Napi::CallbackInfo& info) {
+    bool enabled = info.Length() < 1 || info[0].ToBoolean();
+    netsim::profile::Profiler::instance().enable(enabled);
+    return Napi::Boolean::New(info.Env(), enabled);
+}
+
+// getProfile() returns the per-phase breakdown. "napi" self time is the
+// N-API marshalling cost; "execute" and "export" are the simulation itself.
+Napi::Value NetworkSimulationWrapper::GetProfile(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    netsim::profile::Profiler& profiler = netsim::profile::Profiler::instance();
+    std::vector<netsim::profile::PhaseReport> phases = profiler.report();
+
+    Napi::Array list = Napi::Array::New(env, phases.size());
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const auto& phase = phases[i];
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("name", phase.name);
+        entry.Set("calls", Napi::Number::New(env, static_cast<double>(phase.calls)));
+        entry.Set("totalNs", Napi::Number::New(env, static_cast<double>(phase.totalNs)));
+        entry.Set("selfNs", Napi::Number::New(env, static_cast<double>(phase.selfNs)));
+        entry.Set("tscCycles", Napi::Number::New(env, static_cast<double>(phase.cycles)));
+        if (profiler.hasCounters()) {
+            entry.Set("cycles", Napi::Number::New(env, static_cast<double>(phase.counters[netsim::profile::CounterCycles])));
+            entry.Set("cacheMisses", Napi::Number::New(env, static_cast<double>(phase.counters[netsim::profile::CounterCacheMisses])));
+            entry.Set("branchMisses", Napi::Number::New(env, static_cast<double>(phase.counters[netsim::profile::CounterBranchMisses])));
+        }
+        list.Set(static_cast<uint32_t>(i), entry);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("enabled", Napi::Boolean::New(env, netsim::profile::isEnabled()));
+    result.Set("hardwareCounters", Napi::Boolean::New(env, profiler.hasCounters()));
+    result.Set("phases", list);
+    return result;
+}
+
+Napi::Value NetworkSimulationWrapper::ResetProfile(const Napi::CallbackInfo& info) {
+    netsim::profile::Profiler::instance().reset();
+    return info.Env().Undefined();
+}
+
 // Initialize native addon
 Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
+    netsim::profile::Profiler::instance().enableFromEnvironment("NETSIM_PROFILE");
     return NetworkSimulationWrapper::Init(env, exports);
 }
 
@@ -0,0 +1,392 @@
+// Engine self-profiling shared by the C++ network simulators.
+//
+// NETSIM_PROFILE_SCOPE("name") times the enclosing scope under a named phase:
+// wall time from clock_gettime, TSC cycles where available, hardware counters
+// from perf_event_open on Linux and the number of heap allocations. Phases
+// with the same name are merged, and nested scopes are subtracted from their
+// parent's self time. While profiling is disabled a scope costs one load and
+// a branch.
+//
+// Exactly one translation unit per executable must define
+// NETSIM_PROFILE_IMPLEMENTATION before including this header; it provides the
+// operator new/delete replacements used for allocation counting. A shared
+// library such as the Node addon cannot replace the host's operator new, so
+// it leaves the macro undefined and its allocation counts stay zero.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace netsim {
+namespace profile {
+
+inline std::atomic<bool>& enabledFlag() {
+    static std::atomic<bool> flag{false};
+    return flag;
+}
+
+inline bool isEnabled() {
+    return enabledFlag().load(std::memory_order_relaxed);
+}
+
+// Allocations made by the calling thread, only updated while profiling is
+// enabled. Phases are timed per thread, so a phase is only charged for its
+// own thread's allocations and not, say, the trace writer's.
+struct AllocationCounters {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+inline AllocationCounters& allocations() {
+    // Constant-initialised so operator new can use it before any constructor runs
+    thread_local AllocationCounters counters = {0, 0};
+    return counters;
+}
+
+inline void countAllocation(size_t size) {
+    if (isEnabled()) {
+        AllocationCounters& counters = allocations();
+        ++counters.count;
+        counters.bytes += size;
+    }
+}
+
+inline uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+inline uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+enum Counter { CounterCycles, CounterCacheMisses, CounterBranchMisses, CounterCount };
+
+// perf_event_open group for the thread that enabled profiling. Counters are
+// optional: containers and locked-down kernels usually refuse them.
+class HardwareCounters {
+public:
+    bool open() {
+#ifdef __linux__
+        if (leader >= 0) return true;
+
+        const uint64_t configs[CounterCount] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for (int i = 0; i < CounterCount; ++i) {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            int fd = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : leader, 0);
+            if (fd < 0) {
+                close();
+                return false;
+            }
+            fds[i] = fd;
+            if (i == 0) leader = fd;
+        }
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void close() {
+#ifdef __linux__
+        for (int& fd : fds) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+        leader = -1;
+#endif
+    }
+
+    bool read(uint64_t (&values)[CounterCount]) const {
+#ifdef __linux__
+        uint64_t buffer[1 + CounterCount];
+        if (leader < 0 || ::read(leader, buffer, sizeof(buffer)) != sizeof(buffer)) return false;
+        for (int i = 0; i < CounterCount; ++i) values[i] = buffer[1 + i];
+        return true;
+#else
+        (void)values;
+        return false;
+#endif
+    }
+
+    bool isOpen() const {
+        return leader >= 0;
+    }
+
+private:
+    int leader = -1;
+    int fds[CounterCount] = {-1, -1, -1};
+};
+
+struct PhaseStats {
+    explicit PhaseStats(std::string name) : name(std::move(name)) {}
+
+    const std::string name;
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> selfNs{0};
+    std::atomic<uint64_t> cycles{0};
+    std::atomic<uint64_t> counters[CounterCount] = {};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> allocatedBytes{0};
+};
+
+// Plain copy of a phase for reporting
+struct PhaseReport {
+    std::string name;
+    uint64_t calls;
+    uint64_t totalNs;
+    uint64_t selfNs;
+    uint64_t cycles;
+    uint64_t counters[CounterCount];
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+};
+
+class Profiler {
+public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    PhaseStats& phase(const char* name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& stats : phases) {
+            if (stats.name == name) return stats;
+        }
+        phases.emplace_back(name);
+        return phases.back();
+    }
+
+    // Hardware counters follow the thread that enables profiling. The group
+    // only counts the thread that opened it, so enabling from another thread
+    // reopens it there and the previous owner stops reading it.
+    void enable(bool on) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (on && !enabledFlag().load()) {
+            std::thread::id self = std::this_thread::get_id();
+            if (counters.isOpen() && counterOwner.load() != self) {
+                counterOwner.store(std::thread::id());
+                counters.close();
+            }
+            countersOpen = counters.open();
+            counterOwner.store(countersOpen ? self : std::thread::id());
+        }
+        enabledFlag().store(on);
+    }
+
+    // Enable profiling when the environment variable is set to anything but
+    // an empty string or "0"
+    void enableFromEnvironment(const char* variable) {
+        const char* value = std::getenv(variable);
+        if (value && *value && std::string(value) != "0") enable(true);
+    }
+
+    bool hasCounters() const {
+        return countersOpen;
+    }
+
+    bool readCounters(uint64_t (&values)[CounterCount]) const {
+        return counterOwner.load(std::memory_order_relaxed) == std::this_thread::get_id() &&
+               counters.read(values);
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& stats : phases) {
+            stats.calls = 0;
+            stats.totalNs = 0;
+            stats.selfNs = 0;
+            stats.cycles = 0;
+            for (auto& counter : stats.counters) counter = 0;
+            stats.allocations = 0;
+            stats.allocatedBytes = 0;
+        }
+    }
+
+    std::vector<PhaseReport> report() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<PhaseReport> result;
+        for (const auto& stats : phases) {
+            if (stats.calls == 0) continue;
+            PhaseReport phase;
+            phase.name = stats.name;
+            phase.calls = stats.calls;
+            phase.totalNs = stats.totalNs;
+            phase.selfNs = stats.selfNs;
+            phase.cycles = stats.cycles;
+            for (int i = 0; i < CounterCount; ++i) phase.counters[i] = stats.counters[i];
+            phase.allocations = stats.allocations;
+            phase.allocatedBytes = stats.allocatedBytes;
+            result.push_back(phase);
+        }
+        return result;
+    }
+
+    void print(FILE* out, const char* title) {
+        std::vector<PhaseReport> rows = report();
+        std::fprintf(out, "%s profile (hardware counters %s)\n", title,
+                     hasCounters() ? "enabled" : "unavailable");
+        std::fprintf(out, "%-18s %10s %12s %12s %14s %12s %12s %10s %12s\n",
+                     "phase", "calls", "total ms", "self ms",
+                     hasCounters() ? "cycles" : "tsc cycles", "cache miss",
+                     "branch miss", "allocs", "alloc bytes");
+        for (const auto& phase : rows) {
+            std::fprintf(out, "%-18s %10llu %12.3f %12.3f %14llu %12llu %12llu %10llu %12llu\n",
+                         phase.name.c_str(),
+                         static_cast<unsigned long long>(phase.calls),
+                         phase.totalNs / 1e6, phase.selfNs / 1e6,
+                         static_cast<unsigned long long>(
+                             hasCounters() ? phase.counters[CounterCycles] : phase.cycles),
+                         static_cast<unsigned long long>(phase.counters[CounterCacheMisses]),
+                         static_cast<unsigned long long>(phase.counters[CounterBranchMisses]),
+                         static_cast<unsigned long long>(phase.allocations),
+                         static_cast<unsigned long long>(phase.allocatedBytes));
+        }
+        std::fflush(out);
+    }
+
+private:
+    Profiler() = default;
+
+    std::mutex mutex;
+    std::deque<PhaseStats> phases;
+    HardwareCounters counters;
+    std::atomic<std::thread::id> counterOwner{};
+    bool countersOpen = false;
+};
+
+class ScopedPhase {
+public:
+    explicit ScopedPhase(PhaseStats& stats) : stats(stats), active(isEnabled()) {
+        if (!active) return;
+
+        parent = current();
+        current() = this;
+        allocationCount = allocations().count;
+        allocationBytes = allocations().bytes;
+        hasCounters = Profiler::instance().readCounters(counters);
+        startCycles = readCycles();
+        startNs = nowNs();
+    }
+
+    ~ScopedPhase() {
+        if (!active) return;
+
+        uint64_t elapsed = nowNs() - startNs;
+        uint64_t cycles = readCycles() - startCycles;
+
+        stats.calls.fetch_add(1, std::memory_order_relaxed);
+        stats.totalNs.fetch_add(elapsed, std::memory_order_relaxed);
+        stats.selfNs.fetch_add(elapsed > childNs ? elapsed - childNs : 0, std::memory_order_relaxed);
+        stats.cycles.fetch_add(cycles, std::memory_order_relaxed);
+
+        uint64_t end[CounterCount];
+        if (hasCounters && Profiler::instance().readCounters(end)) {
+            for (int i = 0; i < CounterCount; ++i) {
+                stats.counters[i].fetch_add(end[i] - counters[i], std::memory_order_relaxed);
+            }
+        }
+        stats.allocations.fetch_add(allocations().count - allocationCount, std::memory_order_relaxed);
+        stats.allocatedBytes.fetch_add(allocations().bytes - allocationBytes, std::memory_order_relaxed);
+
+        if (parent) parent->childNs += elapsed;
+        current() = parent;
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    static ScopedPhase*& current() {
+        thread_local ScopedPhase* scope = nullptr;
+        return scope;
+    }
+
+    PhaseStats& stats;
+    bool active;
+    bool hasCounters = false;
+    ScopedPhase* parent = nullptr;
+    uint64_t startNs = 0;
+    uint64_t startCycles = 0;
+    uint64_t childNs = 0;
+    uint64_t allocationCount = 0;
+    uint64_t allocationBytes = 0;
+    uint64_t counters[CounterCount] = {};
+};
+
+}  // namespace profile
+}  // namespace netsim
+
+#define NETSIM_PROFILE_CONCAT_(a, b) a##b
+#define NETSIM_PROFILE_CONCAT(a, b) NETSIM_PROFILE_CONCAT_(a, b)
+
+#define NETSIM_PROFILE_SCOPE(name)                                                        \
+    static ::netsim::profile::PhaseStats& NETSIM_PROFILE_CONCAT(netsimPhase_, __LINE__) = \
+        ::netsim::profile::Profiler::instance().phase(name);                             \
+    ::netsim::profile::ScopedPhase NETSIM_PROFILE_CONCAT(netsimScope_, __LINE__)(          \
+        NETSIM_PROFILE_CONCAT(netsimPhase_, __LINE__))
+
+#ifdef NETSIM_PROFILE_IMPLEMENTATION
+
+// Kept out of line so the compiler does not pair the inlined free() with the
+// new-expression at each call site and warn about a mismatch.
+#if defined(__GNUC__)
+#define NETSIM_PROFILE_NOINLINE __attribute__((noinline))
+#else
+#define NETSIM_PROFILE_NOINLINE
+#endif
+
+NETSIM_PROFILE_NOINLINE void* operator new(size_t size) {
+    netsim::profile::countAllocation(size);
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+NETSIM_PROFILE_NOINLINE void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+NETSIM_PROFILE_NOINLINE void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+#endif
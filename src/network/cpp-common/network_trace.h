@@ -0,0 +1,355 @@
+// Binary packet/event trace recorder shared by the C++ network simulators.
+//
+// Call sites record fixed-size events into a per-thread single-producer ring
+// buffer; a background thread drains the rings and writes them to a trace
+// file. Records are delta/varint encoded on disk, so a steady stream of
+// events costs a few bytes each. Use trace_dump to turn a trace into text or
+// a pcap file.
+//
+// Tracing is selected at compile time: build with -DNETSIM_TRACE=0 and every
+// Tracer::record call compiles to nothing.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef NETSIM_TRACE
+#define NETSIM_TRACE 1
+#endif
+
+namespace netsim {
+namespace trace {
+
+enum class EventKind : uint8_t {
+    Activate = 1,
+    Deactivate = 2,
+    Send = 3,
+    // Written when a ring overflowed; size holds the number of lost events
+    Dropped = 255
+};
+
+enum class Outcome : uint8_t {
+    Ok = 0,
+    SourceInactive = 1,
+    TargetInactive = 2,
+    // Node index outside the topology; src/dst hold the raw indices
+    InvalidIndex = 3
+};
+
+// Fixed-size record as held in the ring buffers and returned by TraceReader
+struct Event {
+    uint64_t timestamp;   // nanoseconds since the session started
+    uint32_t src;
+    uint32_t dst;
+    uint32_t size;
+    uint16_t thread;
+    EventKind kind;
+    Outcome outcome;
+};
+
+static_assert(sizeof(Event) == 24, "trace events must stay fixed-size");
+
+inline const char* kindName(EventKind kind) {
+    switch (kind) {
+        case EventKind::Activate: return "activate";
+        case EventKind::Deactivate: return "deactivate";
+        case EventKind::Send: return "send";
+        case EventKind::Dropped: return "dropped";
+    }
+    return "unknown";
+}
+
+inline const char* outcomeName(Outcome outcome) {
+    switch (outcome) {
+        case Outcome::Ok: return "ok";
+        case Outcome::SourceInactive: return "source-inactive";
+        case Outcome::TargetInactive: return "target-inactive";
+        case Outcome::InvalidIndex: return "invalid-index";
+    }
+    return "unknown";
+}
+
+// Single-producer/single-consumer ring owned by one recording thread
+class Ring {
+public:
+    static constexpr size_t kCapacity = 1 << 16;
+
+    explicit Ring(uint16_t thread) : thread(thread) {}
+
+    bool push(Event event) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= kCapacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        event.thread = thread;
+        events[h & (kCapacity - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void drain(std::vector<Event>& out) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        for (; t != h; ++t) {
+            out.push_back(events[t & (kCapacity - 1)]);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    uint64_t takeDropped() {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    // Consumer side: throws away everything pushed so far
+    void discard() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+        takeDropped();
+    }
+
+    const uint16_t thread;
+
+private:
+    Event events[kCapacity];
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+// On-disk format: the 8-byte magic followed by one record per event:
+// zigzag varint timestamp delta, kind, outcome, then varint thread, src, dst
+// and size.
+static constexpr char kMagic[8] = {'N', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+
+class Encoder {
+public:
+    void encode(const Event& event, std::string& out) {
+        int64_t delta = static_cast<int64_t>(event.timestamp - lastTimestamp);
+        lastTimestamp = event.timestamp;
+        putVarint(out, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+        out.push_back(static_cast<char>(event.kind));
+        out.push_back(static_cast<char>(event.outcome));
+        putVarint(out, event.thread);
+        putVarint(out, event.src);
+        putVarint(out, event.dst);
+        putVarint(out, event.size);
+    }
+
+private:
+    static void putVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    uint64_t lastTimestamp = 0;
+};
+
+class TraceReader {
+public:
+    explicit TraceReader(FILE* file) : file(file) {}
+
+    bool readHeader() {
+        char magic[sizeof(kMagic)];
+        return std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+               std::equal(magic, magic + sizeof(magic), kMagic);
+    }
+
+    // Returns false at end of file or on a truncated record
+    bool next(Event& event) {
+        uint64_t zigzag, thread, src, dst, size;
+        int kind, outcome;
+        if (!getVarint(zigzag)) return false;
+        if ((kind = std::fgetc(file)) == EOF || (outcome = std::fgetc(file)) == EOF) return false;
+        if (!getVarint(thread) || !getVarint(src) || !getVarint(dst) || !getVarint(size)) return false;
+
+        int64_t delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        lastTimestamp += delta;
+        event.timestamp = lastTimestamp;
+        event.kind = static_cast<EventKind>(kind);
+        event.outcome = static_cast<Outcome>(outcome);
+        event.thread = static_cast<uint16_t>(thread);
+        event.src = static_cast<uint32_t>(src);
+        event.dst = static_cast<uint32_t>(dst);
+        event.size = static_cast<uint32_t>(size);
+        return true;
+    }
+
+private:
+    bool getVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = std::fgetc(file);
+            if (c == EOF) return false;
+            value |= static_cast<uint64_t>(c & 0x7f) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        return false;
+    }
+
+    FILE* file;
+    uint64_t lastTimestamp = 0;
+};
+
+// Process-wide recorder: owns the rings and the background writer thread
+class Session {
+public:
+    static Session& instance() {
+        static Session session;
+        return session;
+    }
+
+    bool start(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return false;
+
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        std::fwrite(kMagic, 1, sizeof(kMagic), file);
+
+        // A producer that passed isEnabled() just before the last stop() can
+        // land its event after the final drain; don't carry it into this
+        // file with a timestamp from the old epoch.
+        for (auto& ring : rings) {
+            ring->discard();
+        }
+
+        epoch = std::chrono::steady_clock::now();
+        running = true;
+        stopping = false;
+        enabled.store(true, std::memory_order_release);
+        writer = std::thread(&Session::writerLoop, this);
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running) return;
+            enabled.store(false, std::memory_order_release);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::fclose(file);
+        file = nullptr;
+        running = false;
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    Ring& localRing() {
+        thread_local Ring* ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(mutex);
+            rings.push_back(std::make_unique<Ring>(static_cast<uint16_t>(rings.size())));
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    ~Session() {
+        stop();
+    }
+
+private:
+    Session() = default;
+
+    void writerLoop() {
+        std::vector<Event> batch;
+        std::string encoded;
+        Encoder encoder;
+        bool done = false;
+
+        while (!done) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait_for(lock, std::chrono::milliseconds(20), [this] { return stopping; });
+                done = stopping;
+
+                batch.clear();
+                for (auto& ring : rings) {
+                    ring->drain(batch);
+                    if (uint64_t lost = ring->takeDropped()) {
+                        batch.push_back({now(), 0, 0, static_cast<uint32_t>(std::min<uint64_t>(lost, UINT32_MAX)),
+                                         ring->thread, EventKind::Dropped, Outcome::Ok});
+                    }
+                }
+            }
+
+            // Rings are drained one after another; interleave them by time so
+            // the deltas stay small.
+            std::sort(batch.begin(), batch.end(), [](const Event& a, const Event& b) {
+                return a.timestamp < b.timestamp;
+            });
+
+            encoded.clear();
+            for (const auto& event : batch) {
+                encoder.encode(event, encoded);
+            }
+            std::fwrite(encoded.data(), 1, encoded.size(), file);
+        }
+        std::fflush(file);
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread writer;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::atomic<bool> enabled{false};
+    bool running = false;
+    bool stopping = false;
+    FILE* file = nullptr;
+    std::chrono::steady_clock::time_point epoch;
+};
+
+// Compile-time tracing policies. Call sites go through Tracer, so the
+// disabled policy leaves no code behind.
+struct NullPolicy {
+    static void record(EventKind, uint32_t, uint32_t, uint32_t, Outcome) {}
+};
+
+struct RingPolicy {
+    static void record(EventKind kind, uint32_t src, uint32_t dst, uint32_t size, Outcome outcome) {
+        Session& session = Session::instance();
+        if (!session.isEnabled()) return;
+        session.localRing().push({session.now(), src, dst, size, 0, kind, outcome});
+    }
+};
+
+template <typename Policy>
+struct BasicTracer {
+    static void record(EventKind kind, uint32_t src, uint32_t dst = 0, uint32_t size = 0,
+                       Outcome outcome = Outcome::Ok) {
+        Policy::record(kind, src, dst, size, outcome);
+    }
+};
+
+#if NETSIM_TRACE
+using Tracer = BasicTracer<RingPolicy>;
+#else
+using Tracer = BasicTracer<NullPolicy>;
+#endif
+
+}  // namespace trace
+}  // namespace netsim
@@ -4,24 +4,58 @@ const fs = require('fs');
 const { execSync } = require('child_process');
 
 class NetworkProcessSimulation {
-  constructor() {
+  // options.workers > 1 partitions the topology across that many
+  // network_process workers behind a coordinator; the API is unchanged.
+  constructor(options = {}) {
     this.executablePath = path.join(__dirname, 'network_process');
     this.ensureCompiled();
     
-    this.process = spawn(this.executablePath);
+    const args = options.workers > 1 ? ['--workers', String(options.workers)] : [];
+    this.process = spawn(this.executablePath, args);
     
     this.process.stdout.setEncoding('utf8');
     this.process.stderr.setEncoding('utf8');
     
+    // Replies arrive one per line in command order, so commands can be
+    // pipelined and matched to their callers first-in first-out.
+    this.pending = [];
+    this.buffered = '';
+    this.exitError = null;
+    this.process.stdout.on('data', (data) => this.handleOutput(data));
+    
     this.process.stderr.on('data', (data) => {
       console.error(`Error from C++ process: ${data}`);
     });
     
+    // Once the process is gone no reply will come, so fail every queued
+    // command instead of leaving its promise pending forever.
+    this.process.on('error', (error) => {
+      console.error(`Failed to run C++ process: ${error.message}`);
+      this.failPending(new Error(`C++ process failed: ${error.message}`));
+    });
+    
+    this.process.stdin.on('error', (error) => {
+      this.failPending(new Error(`C++ process stdin failed: ${error.message}`));
+    });
+    
     this.process.on('close', (code) => {
       console.log(`C++ process exited with code ${code}`);
+      this.failPending(new Error(`C++ process exited with code ${code}`));
     });
   }
   
+  failPending(error) {
+    if (!this.exitError) {
+      this.exitError = error;
+    }
+    
+    const pending = this.pending;
+    this.pending = [];
+    for (const request of pending) {
+      request.reject(error);
+    }
+  }
+  
   ensureCompiled() {
     // Check if executable exists, if not compile it
     if (!fs.existsSync(this.executablePath)) {
@@ -36,27 +70,33 @@ class NetworkProcessSimulation {
     }
   }
   
-  async sendCommand(commandStr) {
-    return new Promise((resolve, reject) => {
-      let responseData = '';
+  handleOutput(data) {
+    this.buffered += data;
+    
+    let newline;
+    while ((newline = this.buffered.indexOf('\n')) !== -1) {
+      const line = this.buffered.slice(0, newline).trim();
+      this.buffered = this.buffered.slice(newline + 1);
+      if (!line) continue;
       
-      const responseHandler = (data) => {
-        responseData += data.toString().trim();
-        
-        // Check if we have a complete JSON object
-        if (responseData.startsWith('{') && responseData.endsWith('}')) {
-          try {
-            const response = JSON.parse(responseData);
-            this.process.stdout.removeListener('data', responseHandler);
-            resolve(response);
-          } catch (error) {
-            this.process.stdout.removeListener('data', responseHandler);
-            reject(new Error(`Failed to parse response: ${error.message}, Response: ${responseData}`));
-          }
-        }
-      };
+      const request = this.pending.shift();
+      if (!request) continue;
       
-      this.process.stdout.on('data', responseHandler);
+      try {
+        request.resolve(JSON.parse(line));
+      } catch (error) {
+        request.reject(new Error(`Failed to parse response: ${error.message}, Response: ${line}`));
+      }
+    }
+  }
+  
+  async sendCommand(commandStr) {
+    return new Promise((resolve, reject) => {
+      if (this.exitError) {
+        reject(this.exitError);
+        return;
+      }
+      this.pending.push({ resolve, reject });
       this.process.stdin.write(commandStr + '\n');
     });
   }
@@ -99,6 +139,9 @@ class NetworkProcessSimulation {
   }
   
   close() {
+    if (this.exitError) {
+      return;
+    }
     this.process.stdin.write('exit\n');
     this.process.stdin.end();
   }
@@ -3,6 +3,22 @@
 #include <vector>
 #include <memory>
 #include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define NETSIM_PROFILE_IMPLEMENTATION
+#include "../cpp-common/network_profile.h"
 
 class NetworkNode {
 public:
@@ -81,6 +97,7 @@ public:
 std::string parseCommand(const std::string& input, std::string& command, 
                          std::string& id, std::string& type, std::string& ip, 
                          int& index, int& source, int& target, std::string& data) {
+    NETSIM_PROFILE_SCOPE("parse");
     std::istringstream iss(input);
     std::string token;
     
@@ -110,51 +127,761 @@ std::string parseCommand(const std::string& input, std::string& command,
     return "";
 }
 
-int main() {
+std::string formatResult(bool success) {
+    return success ? "{\"result\":true}" : "{\"result\":false}";
+}
+
+std::string formatNodeInfo(const std::shared_ptr<NetworkNode>& node) {
+    if (!node) {
+        return "{\"result\":{}}";
+    }
+    return "{\"id\":\"" + node->id + "\",\"type\":\"" + node->type +
+           "\",\"ip\":\"" + node->ip + "\",\"active\":" +
+           (node->active ? "true" : "false") + "}";
+}
+
+int runStandalone() {
     NetworkSimulation simulation;
     std::string line;
     
     while (std::getline(std::cin, line)) {
-        std::string command, id, type, ip, data, error;
+        std::string command, id, type, ip, data, error, reply;
         int index = -1, source = -1, target = -1;
         
         error = parseCommand(line, command, id, type, ip, index, source, target, data);
         
         if (!error.empty()) {
-            std::cout << "{\"error\":\"" << error << "\"}" << std::endl;
-            continue;
+            reply = "{\"error\":\"" + error + "\"}";
+        }
+        else if (command == "exit") {
+            break;
+        }
+        else {
+            NETSIM_PROFILE_SCOPE("execute");
+            
+            if (command == "addNode") {
+                reply = "{\"result\":" + std::to_string(simulation.addNode(id, type, ip)) + "}";
+            } 
+            else if (command == "activateNode") {
+                reply = formatResult(simulation.activateNode(index));
+            }
+            else if (command == "deactivateNode") {
+                reply = formatResult(simulation.deactivateNode(index));
+            }
+            else if (command == "sendData") {
+                reply = formatResult(simulation.sendData(source, target, data));
+            }
+            else if (command == "getNodeInfo") {
+                reply = formatNodeInfo(simulation.getNode(index));
+            }
         }
         
-        if (command == "addNode") {
-            int result = simulation.addNode(id, type, ip);
-            std::cout << "{\"result\":" << result << "}" << std::endl;
-        } 
-        else if (command == "activateNode") {
-            bool success = simulation.activateNode(index);
-            std::cout << "{\"result\":" << (success ? "true" : "false") << "}" << std::endl;
+        NETSIM_PROFILE_SCOPE("output");
+        std::cout << reply << std::endl;
+    }
+    
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Distributed mode
+//
+// With --workers K (or --connect) this process is a coordinator: it speaks the
+// same stdin/stdout protocol as the standalone engine but owns no nodes. Node
+// g lives on worker g % K as that worker's local node g / K. Every command is
+// stamped with a global tick and streamed to its worker; replies are collected
+// once per window. A window closes when stdin has nothing more buffered or
+// after kMaxWindow commands, so a client that pipelines commands gets large
+// batches and one that waits for every reply still sees the usual behaviour.
+//
+// A send whose target lives on another worker is held by the source worker
+// until the window closes. The coordinator then relays all of them in one
+// frame per target worker, and the target checks each message against the
+// target node's state at the send's tick, which keeps results identical to
+// the standalone engine.
+// ---------------------------------------------------------------------------
+
+const size_t kMaxWindow = 4096;
+
+enum FrameType : uint8_t {
+    FrameAddNode = 1,
+    FrameActivate,
+    FrameDeactivate,
+    FrameGetNodeInfo,
+    FrameSendLocal,
+    FrameSendRemote,
+    FrameWindowEnd,
+    FrameWindowReport,
+    FrameDeliver,
+    FrameDeliverReport,
+    FrameExit
+};
+
+class WorkerError : public std::runtime_error {
+public:
+    WorkerError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Frames are a type byte, a native-endian 32-bit payload length and the payload
+class FrameBuilder {
+public:
+    explicit FrameBuilder(std::string& out, FrameType type) : out(out), start(out.size()) {
+        out.push_back(static_cast<char>(type));
+        out.append(sizeof(uint32_t), '\0');
+    }
+
+    ~FrameBuilder() {
+        uint32_t length = out.size() - start - 1 - sizeof(uint32_t);
+        std::memcpy(&out[start + 1], &length, sizeof(length));
+    }
+
+    FrameBuilder& u8(uint8_t value) { out.push_back(static_cast<char>(value)); return *this; }
+    FrameBuilder& u32(uint32_t value) { return raw(&value, sizeof(value)); }
+    FrameBuilder& u64(uint64_t value) { return raw(&value, sizeof(value)); }
+
+    FrameBuilder& str(const std::string& value) {
+        u32(value.size());
+        out += value;
+        return *this;
+    }
+
+private:
+    FrameBuilder& raw(const void* data, size_t size) {
+        out.append(static_cast<const char*>(data), size);
+        return *this;
+    }
+
+    std::string& out;
+    size_t start;
+};
+
+class FrameReader {
+public:
+    FrameReader(const std::string& payload) : payload(payload), pos(0) {}
+
+    uint8_t u8() { uint8_t value; raw(&value, sizeof(value)); return value; }
+    uint32_t u32() { uint32_t value; raw(&value, sizeof(value)); return value; }
+    uint64_t u64() { uint64_t value; raw(&value, sizeof(value)); return value; }
+
+    std::string str() {
+        uint32_t size = u32();
+        if (payload.size() - pos < size) throw WorkerError("Truncated frame");
+        std::string value = payload.substr(pos, size);
+        pos += size;
+        return value;
+    }
+
+private:
+    void raw(void* data, size_t size) {
+        if (payload.size() - pos < size) throw WorkerError("Truncated frame");
+        std::memcpy(data, payload.data() + pos, size);
+        pos += size;
+    }
+
+    const std::string& payload;
+    size_t pos;
+};
+
+void writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw WorkerError("Worker connection lost");
+        written += n;
+    }
+}
+
+// Returns false on a clean end of stream before a frame starts
+bool readExact(int fd, void* data, size_t size, bool allowEof = false) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, static_cast<char*>(data) + done, size - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 && done == 0 && allowEof) return false;
+        if (n <= 0) throw WorkerError("Worker connection lost");
+        done += n;
+    }
+    return true;
+}
+
+bool readFrame(int fd, FrameType& type, std::string& payload) {
+    char header[1 + sizeof(uint32_t)];
+    if (!readExact(fd, header, sizeof(header), true)) return false;
+
+    uint32_t length;
+    std::memcpy(&length, header + 1, sizeof(length));
+    type = static_cast<FrameType>(header[0]);
+    payload.resize(length);
+    if (length > 0) readExact(fd, &payload[0], length);
+    return true;
+}
+
+void expectFrame(int fd, FrameType expected, std::string& payload) {
+    FrameType type;
+    if (!readFrame(fd, type, payload) || type != expected) {
+        throw WorkerError("Unexpected frame from worker");
+    }
+}
+
+// One partition of the topology: its nodes, the activation changes made in
+// the current window and the queue of cross-partition messages to deliver
+class PartitionWorker {
+public:
+    explicit PartitionWorker(int fd) : fd(fd) {}
+
+    void run() {
+        FrameType type;
+        std::string payload;
+
+        while (readFrame(fd, type, payload)) {
+            NETSIM_PROFILE_SCOPE("worker.frame");
+            FrameReader in(payload);
+
+            switch (type) {
+                case FrameAddNode: {
+                    std::string id = in.str();
+                    std::string nodeType = in.str();
+                    std::string ip = in.str();
+                    simulation.addNode(id, nodeType, ip);
+                    break;
+                }
+                case FrameActivate:
+                case FrameDeactivate: {
+                    uint64_t tick = in.u64();
+                    int index = in.u32();
+                    auto node = simulation.getNode(index);
+                    if (node) changes[index].push_back({tick, node->active});
+                    if (type == FrameActivate) {
+                        simulation.activateNode(index);
+                    } else {
+                        simulation.deactivateNode(index);
+                    }
+                    break;
+                }
+                case FrameGetNodeInfo: {
+                    in.u64();
+                    replies.push_back(formatNodeInfo(simulation.getNode(in.u32())));
+                    break;
+                }
+                case FrameSendLocal: {
+                    in.u64();
+                    int source = in.u32();
+                    int target = in.u32();
+                    std::string data = in.str();
+                    replies.push_back(formatResult(simulation.sendData(source, target, data)));
+                    break;
+                }
+                case FrameSendRemote: {
+                    RemoteMessage message;
+                    message.tick = in.u64();
+                    int source = in.u32();
+                    message.partition = in.u32();
+                    message.target = in.u32();
+                    message.data = in.str();
+
+                    auto node = simulation.getNode(source);
+                    if (node && node->active) {
+                        // Resolved by the target partition when the window closes
+                        replies.push_back("");
+                        outbound.push_back(message);
+                    } else {
+                        replies.push_back(formatResult(false));
+                    }
+                    break;
+                }
+                case FrameWindowEnd:
+                    endWindow(in.u8() != 0);
+                    break;
+                case FrameExit:
+                    return;
+                default:
+                    throw WorkerError("Unknown frame type");
+            }
         }
-        else if (command == "deactivateNode") {
-            bool success = simulation.deactivateNode(index);
-            std::cout << "{\"result\":" << (success ? "true" : "false") << "}" << std::endl;
+    }
+
+private:
+    struct RemoteMessage {
+        uint64_t tick;
+        uint32_t partition;
+        uint32_t target;
+        std::string data;
+    };
+
+    struct StateChange {
+        uint64_t tick;
+        bool previous;
+    };
+
+    void endWindow(bool exchange) {
+        NETSIM_PROFILE_SCOPE("worker.window");
+        std::string out;
+        {
+            FrameBuilder report(out, FrameWindowReport);
+            report.u32(replies.size());
+            for (const auto& reply : replies) report.str(reply);
+            report.u32(outbound.size());
+            for (const auto& message : outbound) {
+                report.u64(message.tick).u32(message.partition).u32(message.target).str(message.data);
+            }
         }
-        else if (command == "sendData") {
-            bool success = simulation.sendData(source, target, data);
-            std::cout << "{\"result\":" << (success ? "true" : "false") << "}" << std::endl;
+        writeAll(fd, out);
+        replies.clear();
+        outbound.clear();
+
+        if (exchange) {
+            deliver();
+        }
+        changes.clear();
+    }
+
+    void deliver() {
+        NETSIM_PROFILE_SCOPE("worker.deliver");
+        std::string payload;
+        expectFrame(fd, FrameDeliver, payload);
+        FrameReader in(payload);
+
+        std::vector<RemoteMessage> eventQueue(in.u32());
+        for (auto& message : eventQueue) {
+            message.tick = in.u64();
+            message.target = in.u32();
+            message.data = in.str();
+        }
+        std::sort(eventQueue.begin(), eventQueue.end(),
+                  [](const RemoteMessage& a, const RemoteMessage& b) { return a.tick < b.tick; });
+
+        std::string out;
+        {
+            FrameBuilder report(out, FrameDeliverReport);
+            report.u32(eventQueue.size());
+            for (const auto& message : eventQueue) {
+                report.u64(message.tick).u8(activeAt(message.target, message.tick) ? 1 : 0);
+            }
+        }
+        writeAll(fd, out);
+    }
+
+    // State of a local node as of the given tick of the current window
+    bool activeAt(int index, uint64_t tick) {
+        auto node = simulation.getNode(index);
+        if (!node) return false;
+
+        auto log = changes.find(index);
+        if (log != changes.end()) {
+            for (const auto& change : log->second) {
+                if (change.tick > tick) return change.previous;
+            }
+        }
+        return node->active;
+    }
+
+    int fd;
+    NetworkSimulation simulation;
+    std::vector<std::string> replies;
+    std::vector<RemoteMessage> outbound;
+    std::unordered_map<int, std::vector<StateChange>> changes;
+};
+
+// Line reader over stdin that can tell whether another command is already
+// waiting, which is what decides when a window closes
+class LineReader {
+public:
+    bool readLine(std::string& line) {
+        for (;;) {
+            size_t newline = buffer.find('\n', pos);
+            if (newline != std::string::npos) {
+                line = buffer.substr(pos, newline - pos);
+                pos = newline + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            if (eof) {
+                if (pos >= buffer.size()) return false;
+                line = buffer.substr(pos);
+                pos = buffer.size();
+                return true;
+            }
+            fill();
+        }
+    }
+
+    bool pending() {
+        if (buffer.find('\n', pos) != std::string::npos || eof) return true;
+        pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        return poll(&pfd, 1, 0) > 0;
+    }
+
+private:
+    void fill() {
+        buffer.erase(0, pos);
+        pos = 0;
+
+        char chunk[65536];
+        ssize_t n;
+        do {
+            n = read(STDIN_FILENO, chunk, sizeof(chunk));
+        } while (n < 0 && errno == EINTR);
+
+        if (n <= 0) {
+            eof = true;
+        } else {
+            buffer.append(chunk, n);
+        }
+    }
+
+    std::string buffer;
+    size_t pos = 0;
+    bool eof = false;
+};
+
+class Coordinator {
+public:
+    Coordinator(std::vector<int> workerFds, std::vector<pid_t> workerPids)
+        : workers(std::move(workerFds)), pids(std::move(workerPids)),
+          outgoing(workers.size()), replySlots(workers.size()), touched(workers.size(), false) {}
+
+    // Returns false once the client asked to exit
+    bool handle(const std::string& line) {
+        NETSIM_PROFILE_SCOPE("dispatch");
+        std::string command, id, type, ip, data, error;
+        int index = -1, source = -1, target = -1;
+
+        error = parseCommand(line, command, id, type, ip, index, source, target, data);
+        uint64_t now = ++tick;
+
+        if (!error.empty()) {
+            replies.push_back("{\"error\":\"" + error + "\"}");
+            return true;
+        }
+
+        if (command == "addNode") {
+            int global = nodeCount++;
+            FrameBuilder(queue(owner(global)), FrameAddNode).str(id).str(type).str(ip);
+            replies.push_back("{\"result\":" + std::to_string(global) + "}");
+        }
+        else if (command == "activateNode" || command == "deactivateNode") {
+            if (valid(index)) {
+                FrameBuilder(queue(owner(index)), command == "activateNode" ? FrameActivate : FrameDeactivate)
+                    .u64(now).u32(local(index));
+            }
+            replies.push_back(formatResult(valid(index)));
         }
         else if (command == "getNodeInfo") {
-            auto node = simulation.getNode(index);
-            if (node) {
-                std::cout << "{\"id\":\"" << node->id << "\",\"type\":\"" << node->type 
-                          << "\",\"ip\":\"" << node->ip << "\",\"active\":" 
-                          << (node->active ? "true" : "false") << "}" << std::endl;
+            if (valid(index)) {
+                FrameBuilder(queue(owner(index)), FrameGetNodeInfo).u64(now).u32(local(index));
+                expectReply(owner(index));
+            }
+            replies.push_back(formatNodeInfo(nullptr));
+        }
+        else if (command == "sendData") {
+            if (!valid(source) || !valid(target)) {
+                replies.push_back(formatResult(false));
+            } else if (owner(source) == owner(target)) {
+                FrameBuilder(queue(owner(source)), FrameSendLocal)
+                    .u64(now).u32(local(source)).u32(local(target)).str(data);
+                expectReply(owner(source));
+                replies.push_back("");
             } else {
-                std::cout << "{\"result\":{}}" << std::endl;
+                FrameBuilder(queue(owner(source)), FrameSendRemote)
+                    .u64(now).u32(local(source)).u32(owner(target)).u32(local(target)).str(data);
+                expectReply(owner(source));
+                pendingSends[now] = replies.size();
+                replies.push_back("");
+                exchange = true;
             }
         }
         else if (command == "exit") {
-            break;
+            return false;
         }
+
+        return true;
     }
-    
+
+    size_t windowSize() const {
+        return replies.size();
+    }
+
+    void closeWindow() {
+        if (replies.empty()) return;
+        NETSIM_PROFILE_SCOPE("window");
+
+        for (size_t w = 0; w < workers.size(); ++w) {
+            if (!touched[w] && !exchange) continue;
+            FrameBuilder(outgoing[w], FrameWindowEnd).u8(exchange ? 1 : 0);
+            writeAll(workers[w], outgoing[w]);
+            outgoing[w].clear();
+        }
+
+        std::vector<std::string> deliveries(workers.size());
+        std::vector<uint32_t> deliveryCounts(workers.size(), 0);
+        std::string payload;
+
+        for (size_t w = 0; w < workers.size(); ++w) {
+            if (!touched[w] && !exchange) continue;
+            expectFrame(workers[w], FrameWindowReport, payload);
+            FrameReader in(payload);
+
+            uint32_t count = in.u32();
+            if (count != replySlots[w].size()) throw WorkerError("Worker reply count mismatch");
+            for (uint32_t i = 0; i < count; ++i) {
+                std::string reply = in.str();
+                if (!reply.empty()) replies[replySlots[w][i]] = reply;
+            }
+
+            uint32_t messages = in.u32();
+            for (uint32_t i = 0; i < messages; ++i) {
+                uint64_t messageTick = in.u64();
+                uint32_t partition = in.u32();
+                uint32_t targetIndex = in.u32();
+                std::string data = in.str();
+                if (partition >= workers.size()) throw WorkerError("Invalid partition in worker report");
+
+                std::string& batch = deliveries[partition];
+                batch.append(reinterpret_cast<const char*>(&messageTick), sizeof(messageTick));
+                batch.append(reinterpret_cast<const char*>(&targetIndex), sizeof(targetIndex));
+                uint32_t size = data.size();
+                batch.append(reinterpret_cast<const char*>(&size), sizeof(size));
+                batch += data;
+                ++deliveryCounts[partition];
+            }
+        }
+
+        if (exchange) {
+            for (size_t w = 0; w < workers.size(); ++w) {
+                std::string frame;
+                {
+                    FrameBuilder deliver(frame, FrameDeliver);
+                    deliver.u32(deliveryCounts[w]);
+                    frame += deliveries[w];
+                }
+                writeAll(workers[w], frame);
+            }
+
+            for (size_t w = 0; w < workers.size(); ++w) {
+                expectFrame(workers[w], FrameDeliverReport, payload);
+                FrameReader in(payload);
+                uint32_t count = in.u32();
+                for (uint32_t i = 0; i < count; ++i) {
+                    uint64_t messageTick = in.u64();
+                    bool success = in.u8() != 0;
+                    auto slot = pendingSends.find(messageTick);
+                    if (slot != pendingSends.end()) replies[slot->second] = formatResult(success);
+                }
+            }
+        }
+
+        NETSIM_PROFILE_SCOPE("output");
+        std::string out;
+        for (const auto& reply : replies) {
+            out += reply;
+            out += '\n';
+        }
+        std::cout.write(out.data(), out.size());
+        std::cout.flush();
+
+        replies.clear();
+        pendingSends.clear();
+        exchange = false;
+        for (size_t w = 0; w < workers.size(); ++w) {
+            replySlots[w].clear();
+            touched[w] = false;
+        }
+    }
+
+    void shutdown() {
+        for (size_t w = 0; w < workers.size(); ++w) {
+            std::string frame;
+            FrameBuilder(frame, FrameExit);
+            try {
+                writeAll(workers[w], frame);
+            } catch (const WorkerError&) {
+                // Already gone
+            }
+            close(workers[w]);
+        }
+        for (pid_t pid : pids) {
+            waitpid(pid, nullptr, 0);
+        }
+    }
+
+private:
+    size_t owner(int index) const { return index % workers.size(); }
+    uint32_t local(int index) const { return index / workers.size(); }
+    bool valid(int index) const { return index >= 0 && index < nodeCount; }
+
+    std::string& queue(size_t worker) {
+        touched[worker] = true;
+        return outgoing[worker];
+    }
+
+    void expectReply(size_t worker) {
+        replySlots[worker].push_back(replies.size());
+    }
+
+    std::vector<int> workers;
+    std::vector<pid_t> pids;
+    std::vector<std::string> outgoing;
+    std::vector<std::vector<size_t>> replySlots;
+    std::vector<bool> touched;
+    std::vector<std::string> replies;
+    std::unordered_map<uint64_t, size_t> pendingSends;
+    uint64_t tick = 0;
+    int nodeCount = 0;
+    bool exchange = false;
+};
+
+int spawnWorker(pid_t& pid) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        throw WorkerError(std::string("socketpair failed: ") + std::strerror(errno));
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        throw WorkerError(std::string("fork failed: ") + std::strerror(errno));
+    }
+    if (pid == 0) {
+        fcntl(fds[1], F_SETFD, 0);
+        std::string fd = std::to_string(fds[1]);
+        execl("/proc/self/exe", "network_process", "--worker-fd", fd.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    close(fds[1]);
+    return fds[0];
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw WorkerError("Socket path too long: " + path);
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+int connectWorker(const std::string& path) {
+    sockaddr_un addr = socketAddress(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        throw WorkerError("Failed to connect to worker " + path + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+// Serve one coordinator connection on a Unix socket, then exit
+int listenWorker(const std::string& path) {
+    sockaddr_un addr = socketAddress(path);
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(path.c_str());
+    if (server < 0 || bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(server, 1) != 0) {
+        throw WorkerError("Failed to listen on " + path + ": " + std::strerror(errno));
+    }
+
+    int fd;
+    do {
+        fd = accept(server, nullptr, nullptr);
+    } while (fd < 0 && errno == EINTR);
+    close(server);
+    unlink(path.c_str());
+    if (fd < 0) {
+        throw WorkerError(std::string("accept failed: ") + std::strerror(errno));
+    }
+    return fd;
+}
+
+int runCoordinator(std::vector<int> workers, std::vector<pid_t> pids) {
+    Coordinator coordinator(std::move(workers), std::move(pids));
+    LineReader reader;
+    std::string line;
+
+    while (reader.readLine(line)) {
+        if (!coordinator.handle(line)) break;
+        if (coordinator.windowSize() >= kMaxWindow || !reader.pending()) {
+            coordinator.closeWindow();
+        }
+    }
+
+    coordinator.closeWindow();
+    coordinator.shutdown();
     return 0;
 }
+
+std::string profileTitle = "network_process";
+
+int runEngine(int argc, char* argv[]) {
+    if (argc < 2) {
+        return runStandalone();
+    }
+
+    // A dead worker should surface as an error, not kill the coordinator
+    std::signal(SIGPIPE, SIG_IGN);
+    try {
+        std::string mode = argv[1];
+
+        if (mode == "--worker-fd" && argc > 2) {
+            profileTitle = "network_process worker " + std::to_string(getpid());
+            PartitionWorker(std::stoi(argv[2])).run();
+            return 0;
+        }
+        if (mode == "--listen" && argc > 2) {
+            profileTitle = "network_process worker " + std::to_string(getpid());
+            PartitionWorker(listenWorker(argv[2])).run();
+            return 0;
+        }
+        if (mode == "--workers" && argc > 2) {
+            int count = std::stoi(argv[2]);
+            if (count < 1) {
+                std::cerr << "Worker count must be at least 1" << std::endl;
+                return 1;
+            }
+
+            std::vector<int> fds;
+            std::vector<pid_t> pids;
+            for (int i = 0; i < count; ++i) {
+                pid_t pid;
+                fds.push_back(spawnWorker(pid));
+                pids.push_back(pid);
+            }
+            return runCoordinator(std::move(fds), std::move(pids));
+        }
+        if (mode == "--connect" && argc > 2) {
+            std::vector<int> fds;
+            std::istringstream paths(argv[2]);
+            std::string path;
+            while (std::getline(paths, path, ',')) {
+                if (!path.empty()) fds.push_back(connectWorker(path));
+            }
+            if (fds.empty()) {
+                std::cerr << "No worker sockets given" << std::endl;
+                return 1;
+            }
+            return runCoordinator(std::move(fds), {});
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cerr << "Usage: " << argv[0]
+              << " [--workers <count> | --connect <socket>[,<socket>...] | --listen <socket>]" << std::endl;
+    return 1;
+}
+
+// NETSIM_PROFILE=1 prints a per-phase report on stderr at exit; stdout
+// carries the command protocol. Workers inherit the variable and report too.
+int main(int argc, char* argv[]) {
+    netsim::profile::Profiler& profiler = netsim::profile::Profiler::instance();
+    profiler.enableFromEnvironment("NETSIM_PROFILE");
+
+    int status = runEngine(argc, argv);
+
+    if (netsim::profile::isEnabled()) {
+        profiler.print(stderr, profileTitle.c_str());
+    }
+    return status;
+}
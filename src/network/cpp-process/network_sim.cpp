@@ -4,6 +4,17 @@
 #include <vector>
 #include <memory>
 
+#define NETSIM_PROFILE_IMPLEMENTATION
+#include "../cpp-common/network_profile.h"
+#include "../cpp-common/network_trace.h"
+
+using netsim::trace::EventKind;
+using netsim::trace::Outcome;
+using netsim::trace::Tracer;
+
+// Human-readable per-operation logging, enabled with --verbose
+static bool verbose = false;
+
 // Simple class to represent a network node
 class NetworkNode {
 public:
@@ -11,36 +22,43 @@ public:
     std::string type;
     std::string ip;
     bool active;
+    uint32_t index;
 
-    NetworkNode(std::string id, std::string type, std::string ip)
-        : id(id), type(type), ip(ip), active(false) {}
+    NetworkNode(std::string id, std::string type, std::string ip, uint32_t index = 0)
+        : id(id), type(type), ip(ip), active(false), index(index) {}
 
     void activate() {
         active = true;
-        std::cout << "Node " << id << " activated" << std::endl;
+        Tracer::record(EventKind::Activate, index);
+        if (verbose) std::cout << "Node " << id << " activated\n";
     }
 
     void deactivate() {
         active = false;
-        std::cout << "Node " << id << " deactivated" << std::endl;
+        Tracer::record(EventKind::Deactivate, index);
+        if (verbose) std::cout << "Node " << id << " deactivated\n";
     }
 
     bool sendData(NetworkNode& target, const std::string& data) {
         if (!active) {
-            std::cout << "Error: Source node " << id << " is not active" << std::endl;
+            Tracer::record(EventKind::Send, index, target.index, data.size(), Outcome::SourceInactive);
+            if (verbose) std::cout << "Error: Source node " << id << " is not active\n";
             return false;
         }
         if (!target.active) {
-            std::cout << "Error: Target node " << target.id << " is not active" << std::endl;
+            Tracer::record(EventKind::Send, index, target.index, data.size(), Outcome::TargetInactive);
+            if (verbose) std::cout << "Error: Target node " << target.id << " is not active\n";
             return false;
         }
-        std::cout << "Data sent from " << id << " to " << target.id << ": " << data << std::endl;
+        Tracer::record(EventKind::Send, index, target.index, data.size());
+        if (verbose) std::cout << "Data sent from " << id << " to " << target.id << ": " << data << "\n";
         return true;
     }
 };
 
 // Very simple JSON parser for our specific format
 std::vector<NetworkNode> parseNodes(const std::string& json) {
+    NETSIM_PROFILE_SCOPE("parse");
     std::vector<NetworkNode> nodes;
     
     // Find the nodes array
@@ -103,7 +121,7 @@ std::vector<NetworkNode> parseNodes(const std::string& json) {
         }
         
         if (!id.empty() && !type.empty() && !ip.empty()) {
-            nodes.emplace_back(id, type, ip);
+            nodes.emplace_back(id, type, ip, nodes.size());
         }
         
         pos = objEnd + 1;
@@ -114,6 +132,7 @@ std::vector<NetworkNode> parseNodes(const std::string& json) {
 
 // Process actions from JSON
 void processActions(const std::string& json, std::vector<NetworkNode>& nodes, std::vector<std::string>& results) {
+    NETSIM_PROFILE_SCOPE("actions");
     // Find the actions array
     size_t actionsStart = json.find("\"actions\"");
     if (actionsStart == std::string::npos) return;
@@ -204,28 +223,42 @@ void processActions(const std::string& json, std::vector<NetworkNode>& nodes, st
         
         if (type == "activate") {
             if (nodeIndex >= 0 && nodeIndex < static_cast<int>(nodes.size())) {
-                nodes[nodeIndex].activate();
+                {
+                    NETSIM_PROFILE_SCOPE("execute");
+                    nodes[nodeIndex].activate();
+                }
                 result += "\"nodeIndex\":" + std::to_string(nodeIndex) + ",\"success\":true}";
             } else {
+                Tracer::record(EventKind::Activate, static_cast<uint32_t>(nodeIndex), 0, 0, Outcome::InvalidIndex);
                 result += "\"nodeIndex\":" + std::to_string(nodeIndex) + ",\"success\":false}";
             }
         } 
         else if (type == "deactivate") {
             if (nodeIndex >= 0 && nodeIndex < static_cast<int>(nodes.size())) {
-                nodes[nodeIndex].deactivate();
+                {
+                    NETSIM_PROFILE_SCOPE("execute");
+                    nodes[nodeIndex].deactivate();
+                }
                 result += "\"nodeIndex\":" + std::to_string(nodeIndex) + ",\"success\":true}";
             } else {
+                Tracer::record(EventKind::Deactivate, static_cast<uint32_t>(nodeIndex), 0, 0, Outcome::InvalidIndex);
                 result += "\"nodeIndex\":" + std::to_string(nodeIndex) + ",\"success\":false}";
             }
         }
         else if (type == "sendData") {
             if (sourceIndex >= 0 && sourceIndex < static_cast<int>(nodes.size()) && 
                 targetIndex >= 0 && targetIndex < static_cast<int>(nodes.size())) {
-                bool success = nodes[sourceIndex].sendData(nodes[targetIndex], data);
+                bool success;
+                {
+                    NETSIM_PROFILE_SCOPE("execute");
+                    success = nodes[sourceIndex].sendData(nodes[targetIndex], data);
+                }
                 result += "\"sourceIndex\":" + std::to_string(sourceIndex) + 
                          ",\"targetIndex\":" + std::to_string(targetIndex) + 
                          ",\"data\":\"" + data + "\",\"success\":" + (success ? "true" : "false") + "}";
             } else {
+                Tracer::record(EventKind::Send, static_cast<uint32_t>(sourceIndex), static_cast<uint32_t>(targetIndex),
+                               data.size(), Outcome::InvalidIndex);
                 result += "\"sourceIndex\":" + std::to_string(sourceIndex) + 
                          ",\"targetIndex\":" + std::to_string(targetIndex) + 
                          ",\"data\":\"" + data + "\",\"success\":false}";
@@ -239,34 +272,47 @@ void processActions(const std::string& json, std::vector<NetworkNode>& nodes, st
 
 // Generate JSON output
 std::string generateOutput(const std::vector<NetworkNode>& nodes, const std::vector<std::string>& actionResults) {
-    std::string output = "{\"nodes\":[";
+    NETSIM_PROFILE_SCOPE("output");
+    // Size the buffer up front and append in place; building each node with
+    // operator+ allocates a temporary string per field.
+    size_t size = 32;
+    for (const auto& node : nodes) {
+        size += node.id.size() + node.type.size() + node.ip.size() + 48;
+    }
+    for (const auto& result : actionResults) {
+        size += result.size() + 1;
+    }
+
+    std::string output;
+    output.reserve(size);
+    output += "{\"nodes\":[";
     
     for (size_t i = 0; i < nodes.size(); ++i) {
         const auto& node = nodes[i];
-        output += "{\"id\":\"" + node.id + "\",\"type\":\"" + node.type + 
-                 "\",\"ip\":\"" + node.ip + "\",\"active\":" + (node.active ? "true" : "false") + "}";
-        if (i < nodes.size() - 1) output += ",";
+        if (i > 0) output += ',';
+        output += "{\"id\":\"";
+        output += node.id;
+        output += "\",\"type\":\"";
+        output += node.type;
+        output += "\",\"ip\":\"";
+        output += node.ip;
+        output += "\",\"active\":";
+        output += node.active ? "true}" : "false}";
     }
     
     output += "],\"actions\":[";
     
     for (size_t i = 0; i < actionResults.size(); ++i) {
+        if (i > 0) output += ',';
         output += actionResults[i];
-        if (i < actionResults.size() - 1) output += ",";
     }
     
     output += "]}";
     return output;
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file>" << std::endl;
-        return 1;
-    }
-
-    std::string inputFile = argv[1];
-    std::string outputFile = argv[2];
+int runSimulation(const std::string& inputFile, const std::string& outputFile) {
+    NETSIM_PROFILE_SCOPE("run");
 
     try {
         // Read input configuration
@@ -276,8 +322,12 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
-        std::string json((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
-        input.close();
+        std::string json;
+        {
+            NETSIM_PROFILE_SCOPE("read");
+            json.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            input.close();
+        }
         
         // Parse nodes
         std::vector<NetworkNode> nodes = parseNodes(json);
@@ -287,6 +337,7 @@ int main(int argc, char* argv[]) {
         std::vector<std::string> actionResults;
         processActions(json, nodes, actionResults);
         std::cout << "Processed " << actionResults.size() << " actions" << std::endl;
+        netsim::trace::Session::instance().stop();
         
         // Generate output
         std::string output = generateOutput(nodes, actionResults);
@@ -298,8 +349,11 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
-        outFile << output;
-        outFile.close();
+        {
+            NETSIM_PROFILE_SCOPE("write");
+            outFile << output;
+            outFile.close();
+        }
         
         std::cout << "Simulation completed successfully" << std::endl;
         return 0;
@@ -309,3 +363,51 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 }
+
+int main(int argc, char* argv[]) {
+    std::string traceFile;
+    bool profile = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.size() < 2) {
+        std::cerr << "Usage: " << argv[0] << " [--verbose] [--profile] [--trace <trace_file>] <input_file> <output_file>" << std::endl;
+        return 1;
+    }
+
+    std::string inputFile = files[0];
+    std::string outputFile = files[1];
+
+    if (profile) {
+        netsim::profile::Profiler::instance().enable(true);
+    }
+
+    if (!traceFile.empty()) {
+        if (!NETSIM_TRACE) {
+            std::cerr << "Tracing is disabled in this build, ignoring --trace" << std::endl;
+        } else if (!netsim::trace::Session::instance().start(traceFile)) {
+            std::cerr << "Failed to open trace file: " << traceFile << std::endl;
+            return 1;
+        }
+    }
+
+    int status = runSimulation(inputFile, outputFile);
+
+    // Report on stderr; stdout is read by network-process.js
+    if (profile) {
+        netsim::profile::Profiler::instance().print(stderr, "network_sim");
+    }
+    return status;
+}
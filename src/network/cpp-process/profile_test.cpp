@@ -0,0 +1,121 @@
+// Checks for the phase profiler: self time of nested scopes, per-phase call
+// counts, reset, per-thread allocation counts and hardware counter ownership.
+// Run with `make test`.
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NETSIM_PROFILE_IMPLEMENTATION
+#include "../cpp-common/network_profile.h"
+
+using namespace netsim::profile;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: "      \
+                      << #condition << std::endl;                               \
+            ++failures;                                                         \
+        }                                                                       \
+    } while (0)
+
+static PhaseReport findPhase(const std::string& name) {
+    for (const auto& phase : Profiler::instance().report()) {
+        if (phase.name == name) return phase;
+    }
+    return PhaseReport{name, 0, 0, 0, 0, {0, 0, 0}, 0, 0};
+}
+
+static void inner() {
+    NETSIM_PROFILE_SCOPE("inner");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+static void outer() {
+    NETSIM_PROFILE_SCOPE("outer");
+    for (int i = 0; i < 3; ++i) inner();
+}
+
+static void testNestedSelfTime() {
+    Profiler::instance().reset();
+    outer();
+    outer();
+
+    PhaseReport outerPhase = findPhase("outer");
+    PhaseReport innerPhase = findPhase("inner");
+    CHECK(outerPhase.calls == 2);
+    CHECK(innerPhase.calls == 6);
+    CHECK(innerPhase.totalNs >= 6 * 2000000ull);
+    // Children are subtracted from the parent, and leaves keep all their time
+    CHECK(outerPhase.selfNs + innerPhase.totalNs == outerPhase.totalNs);
+    CHECK(outerPhase.selfNs < innerPhase.totalNs);
+    CHECK(innerPhase.selfNs == innerPhase.totalNs);
+}
+
+static void testReset() {
+    outer();
+    CHECK(!Profiler::instance().report().empty());
+    Profiler::instance().reset();
+    CHECK(Profiler::instance().report().empty());
+    CHECK(findPhase("outer").calls == 0);
+}
+
+// Another thread's allocations during a phase are not charged to it
+static void testAllocationsPerThread() {
+    Profiler::instance().reset();
+    std::vector<std::unique_ptr<int>> local;
+    {
+        NETSIM_PROFILE_SCOPE("allocate");
+        std::thread other([] {
+            std::vector<std::unique_ptr<int>> remote;
+            for (int i = 0; i < 100; ++i) remote.push_back(std::make_unique<int>(i));
+        });
+        other.join();
+        for (int i = 0; i < 4; ++i) local.push_back(std::unique_ptr<int>(new int(i)));
+    }
+
+    PhaseReport phase = findPhase("allocate");
+    CHECK(phase.calls == 1);
+    CHECK(phase.allocations >= 4);
+    CHECK(phase.allocations < 100);
+    CHECK(phase.allocatedBytes >= 4 * sizeof(int));
+}
+
+// Counters opened on one thread must not be read from another after
+// profiling was re-enabled there
+static void testCounterOwnership() {
+    uint64_t values[CounterCount];
+    Profiler& profiler = Profiler::instance();
+    profiler.enable(false);
+
+    std::thread other([&] {
+        profiler.enable(true);
+        CHECK(profiler.readCounters(values) == profiler.hasCounters());
+    });
+    other.join();
+    CHECK(!profiler.readCounters(values));
+
+    profiler.enable(false);
+    profiler.enable(true);
+    CHECK(profiler.readCounters(values) == profiler.hasCounters());
+}
+
+int main() {
+    Profiler::instance().enable(true);
+    testNestedSelfTime();
+    testReset();
+    testAllocationsPerThread();
+    testCounterOwnership();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "profile_test passed" << std::endl;
+    return 0;
+}
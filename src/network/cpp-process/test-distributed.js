@@ -0,0 +1,51 @@
+const { NetworkProcessSimulation } = require('./network-process-wrapper');
+
+// Runs the same pipelined workload on the standalone engine and on a
+// coordinator with several worker processes and compares the replies.
+async function runWorkload(simulation) {
+  const nodeCount = 12;
+  const indices = await Promise.all(
+    Array.from({ length: nodeCount }, (_, i) => simulation.addNode(`node-${i}`, 'client', `10.0.0.${i + 1}`))
+  );
+  
+  const results = [];
+  for (let round = 0; round < 3; round++) {
+    const commands = [];
+    for (const index of indices) {
+      if ((index + round) % 3 === 0) {
+        commands.push(simulation.deactivateNode(index));
+      } else {
+        commands.push(simulation.activateNode(index));
+      }
+      commands.push(simulation.sendData(index, (index * 5 + round) % nodeCount, `round ${round}`));
+    }
+    results.push(...await Promise.all(commands));
+  }
+  
+  results.push(...await Promise.all(indices.map((index) => simulation.getNodeInfo(index))));
+  simulation.close();
+  return results;
+}
+
+async function runTest() {
+  console.log('Running distributed network simulation...');
+  
+  try {
+    const expected = await runWorkload(new NetworkProcessSimulation());
+    const actual = await runWorkload(new NetworkProcessSimulation({ workers: 3 }));
+    
+    if (JSON.stringify(expected) !== JSON.stringify(actual)) {
+      console.error('Test failed: distributed results differ from standalone results');
+      process.exitCode = 1;
+      return;
+    }
+    
+    console.log(`Compared ${actual.length} replies across 3 workers`);
+    console.log('Test completed successfully');
+  } catch (error) {
+    console.error('Test failed:', error.message);
+    process.exitCode = 1;
+  }
+}
+
+runTest();
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "../cpp-common/network_trace.h"
+
+using netsim::trace::Event;
+using netsim::trace::TraceReader;
+
+// pcap with nanosecond timestamps; each packet is one 24-byte record on the
+// LINKTYPE_USER0 link type
+static const uint32_t kPcapMagicNanos = 0xa1b23c4d;
+static const uint32_t kLinkTypeUser0 = 147;
+
+static void putLE(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+static void writePcapHeader(FILE* out) {
+    std::string header;
+    putLE(header, kPcapMagicNanos, 4);
+    putLE(header, 2, 2);        // version major
+    putLE(header, 4, 2);        // version minor
+    putLE(header, 0, 4);        // thiszone
+    putLE(header, 0, 4);        // sigfigs
+    putLE(header, 65535, 4);    // snaplen
+    putLE(header, kLinkTypeUser0, 4);
+    std::fwrite(header.data(), 1, header.size(), out);
+}
+
+static void writePcapRecord(FILE* out, const Event& event) {
+    std::string packet;
+    putLE(packet, event.timestamp / 1000000000, 4);
+    putLE(packet, event.timestamp % 1000000000, 4);
+    putLE(packet, sizeof(Event), 4);
+    putLE(packet, sizeof(Event), 4);
+    putLE(packet, event.timestamp, 8);
+    putLE(packet, event.src, 4);
+    putLE(packet, event.dst, 4);
+    putLE(packet, event.size, 4);
+    putLE(packet, event.thread, 2);
+    putLE(packet, static_cast<uint8_t>(event.kind), 1);
+    putLE(packet, static_cast<uint8_t>(event.outcome), 1);
+    std::fwrite(packet.data(), 1, packet.size(), out);
+}
+
+static void writeTextRecord(FILE* out, const Event& event) {
+    std::fprintf(out, "%llu.%09llu t%u %-10s src=%u dst=%u size=%u %s\n",
+                 static_cast<unsigned long long>(event.timestamp / 1000000000),
+                 static_cast<unsigned long long>(event.timestamp % 1000000000),
+                 event.thread, netsim::trace::kindName(event.kind),
+                 event.src, event.dst, event.size,
+                 netsim::trace::outcomeName(event.outcome));
+}
+
+int main(int argc, char* argv[]) {
+    std::string format = "text";
+    std::string inputFile, outputFile;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (inputFile.empty()) {
+            inputFile = arg;
+        } else {
+            outputFile = arg;
+        }
+    }
+
+    if (inputFile.empty() || (format != "text" && format != "pcap")) {
+        std::cerr << "Usage: " << argv[0] << " [--format text|pcap] <trace_file> [output_file]" << std::endl;
+        return 1;
+    }
+
+    FILE* input = std::fopen(inputFile.c_str(), "rb");
+    if (!input) {
+        std::cerr << "Failed to open trace file: " << inputFile << std::endl;
+        return 1;
+    }
+
+    TraceReader reader(input);
+    if (!reader.readHeader()) {
+        std::cerr << "Not a network trace file: " << inputFile << std::endl;
+        std::fclose(input);
+        return 1;
+    }
+
+    FILE* output = outputFile.empty() ? stdout : std::fopen(outputFile.c_str(), "wb");
+    if (!output) {
+        std::cerr << "Failed to open output file: " << outputFile << std::endl;
+        std::fclose(input);
+        return 1;
+    }
+
+    if (format == "pcap") writePcapHeader(output);
+
+    Event event;
+    size_t count = 0;
+    while (reader.next(event)) {
+        if (format == "pcap") {
+            writePcapRecord(output, event);
+        } else {
+            writeTextRecord(output, event);
+        }
+        ++count;
+    }
+
+    std::fclose(input);
+    if (output != stdout) {
+        std::fclose(output);
+        std::cerr << "Converted " << count << " events" << std::endl;
+    }
+    return 0;
+}
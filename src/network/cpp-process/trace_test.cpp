@@ -0,0 +1,167 @@
+// Round-trip checks for the trace recorder: Encoder -> TraceReader, and a full
+// Session run read back from disk. Run with `make test`.
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "../cpp-common/network_trace.h"
+
+using namespace netsim::trace;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: "      \
+                      << #condition << std::endl;                               \
+            ++failures;                                                         \
+        }                                                                       \
+    } while (0)
+
+static bool sameEvent(const Event& a, const Event& b) {
+    return a.timestamp == b.timestamp && a.src == b.src && a.dst == b.dst &&
+           a.size == b.size && a.thread == b.thread && a.kind == b.kind &&
+           a.outcome == b.outcome;
+}
+
+static std::vector<Event> readTrace(FILE* file) {
+    std::vector<Event> events;
+    TraceReader reader(file);
+    CHECK(reader.readHeader());
+    Event event;
+    while (reader.next(event)) events.push_back(event);
+    return events;
+}
+
+// Timestamps go backwards between the second and third record, as they can
+// across writer batches, and the fields use the full varint range.
+static void testEncoderRoundTrip() {
+    const std::vector<Event> expected = {
+        {1000, 0, 0, 0, 0, EventKind::Activate, Outcome::Ok},
+        {5000000000ull, 7, 300, 65536, 1, EventKind::Send, Outcome::TargetInactive},
+        {2500, UINT32_MAX, 0, 0, 2, EventKind::Deactivate, Outcome::InvalidIndex},
+        {2500, 0, 0, 123456, 1, EventKind::Dropped, Outcome::Ok},
+        {0, 1, 2, UINT32_MAX, 65535, EventKind::Send, Outcome::SourceInactive},
+    };
+
+    std::string encoded(kMagic, sizeof(kMagic));
+    Encoder encoder;
+    for (const auto& event : expected) encoder.encode(event, encoded);
+
+    FILE* file = std::tmpfile();
+    std::fwrite(encoded.data(), 1, encoded.size(), file);
+    std::rewind(file);
+    std::vector<Event> actual = readTrace(file);
+    std::fclose(file);
+
+    CHECK(actual.size() == expected.size());
+    for (size_t i = 0; i < actual.size() && i < expected.size(); ++i) {
+        CHECK(sameEvent(actual[i], expected[i]));
+    }
+
+    // A truncated record ends the stream instead of producing garbage
+    file = std::tmpfile();
+    std::fwrite(encoded.data(), 1, encoded.size() - 1, file);
+    std::rewind(file);
+    CHECK(readTrace(file).size() == expected.size() - 1);
+    std::fclose(file);
+}
+
+static void testSessionRoundTrip() {
+    char path[] = "/tmp/netsim-trace-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    close(fd);
+
+    const uint32_t perThread = 5000;
+    CHECK(Session::instance().start(path));
+
+    auto record = [perThread](uint32_t base) {
+        for (uint32_t i = 0; i < perThread; ++i) {
+            RingPolicy::record(EventKind::Send, base + i, i, i % 97,
+                               i % 10 == 0 ? Outcome::InvalidIndex : Outcome::Ok);
+        }
+    };
+    std::thread other(record, 1000000);
+    record(0);
+    other.join();
+    Session::instance().stop();
+
+    FILE* file = std::fopen(path, "rb");
+    CHECK(file != nullptr);
+    if (!file) return;
+    std::vector<Event> events = readTrace(file);
+    std::fclose(file);
+    std::remove(path);
+
+    // Each thread's events come back complete and in order
+    std::vector<uint32_t> next(2, 0);
+    uint64_t dropped = 0;
+    size_t sends = 0;
+    for (const auto& event : events) {
+        if (event.kind == EventKind::Dropped) {
+            dropped += event.size;
+            continue;
+        }
+        CHECK(event.kind == EventKind::Send);
+        int owner = event.src >= 1000000 ? 1 : 0;
+        uint32_t i = event.src - (owner ? 1000000 : 0);
+        CHECK(i >= next[owner]);
+        next[owner] = i + 1;
+        CHECK(event.dst == i);
+        CHECK(event.size == i % 97);
+        CHECK(event.outcome == (i % 10 == 0 ? Outcome::InvalidIndex : Outcome::Ok));
+        ++sends;
+    }
+    CHECK(sends + dropped == 2 * perThread);
+}
+
+// A producer that passed isEnabled() right before stop() pushes after the
+// final drain; the next session must not write that event.
+static void testRestartDropsStaleEvents() {
+    char path[] = "/tmp/netsim-trace-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    close(fd);
+
+    CHECK(Session::instance().start(path));
+    Session::instance().stop();
+    Session::instance().localRing().push({0, 42, 0, 0, 0, EventKind::Send, Outcome::Ok});
+
+    CHECK(Session::instance().start(path));
+    BasicTracer<RingPolicy>::record(EventKind::Activate, 7);
+    Session::instance().stop();
+
+    FILE* file = std::fopen(path, "rb");
+    CHECK(file != nullptr);
+    if (!file) return;
+    std::vector<Event> events = readTrace(file);
+    std::fclose(file);
+    std::remove(path);
+
+    CHECK(events.size() == 1);
+    if (!events.empty()) {
+        CHECK(events[0].kind == EventKind::Activate);
+        CHECK(events[0].src == 7);
+    }
+}
+
+int main() {
+    testEncoderRoundTrip();
+    testSessionRoundTrip();
+    testRestartDropsStaleEvents();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "trace_test passed" << std::endl;
+    return 0;
+}
@@ -2,6 +2,17 @@
 #include <vector>
 #include <string>
 
+#define NETSIM_PROFILE_IMPLEMENTATION
+#include "cpp-common/network_profile.h"
+#include "cpp-common/network_trace.h"
+
+using netsim::trace::EventKind;
+using netsim::trace::Outcome;
+using netsim::trace::Tracer;
+
+// Human-readable per-operation logging, enabled with --verbose
+static bool verbose = false;
+
 // Simple network node representation
 class NetworkNode {
 public:
@@ -9,43 +20,74 @@ public:
     std::string type;
     std::string ip;
     bool active;
+    uint32_t index;
 
-    NetworkNode(std::string id, std::string type, std::string ip)
-        : id(id), type(type), ip(ip), active(false) {}
+    NetworkNode(std::string id, std::string type, std::string ip, uint32_t index)
+        : id(id), type(type), ip(ip), active(false), index(index) {}
 
     void activate() {
         active = true;
-        std::cout << "Node " << id << " (" << ip << ") activated" << std::endl;
+        Tracer::record(EventKind::Activate, index);
+        if (verbose) std::cout << "Node " << id << " (" << ip << ") activated\n";
     }
 
     void deactivate() {
         active = false;
-        std::cout << "Node " << id << " (" << ip << ") deactivated" << std::endl;
+        Tracer::record(EventKind::Deactivate, index);
+        if (verbose) std::cout << "Node " << id << " (" << ip << ") deactivated\n";
     }
 
     void sendData(const NetworkNode& target, const std::string& data) {
         if (!active) {
-            std::cout << "Error: Source node " << id << " is not active" << std::endl;
+            Tracer::record(EventKind::Send, index, target.index, data.size(), Outcome::SourceInactive);
+            if (verbose) std::cout << "Error: Source node " << id << " is not active\n";
             return;
         }
         if (!target.active) {
-            std::cout << "Error: Target node " << target.id << " is not active" << std::endl;
+            Tracer::record(EventKind::Send, index, target.index, data.size(), Outcome::TargetInactive);
+            if (verbose) std::cout << "Error: Target node " << target.id << " is not active\n";
             return;
         }
-        std::cout << "Data sent from " << id << " to " << target.id << ": " << data << std::endl;
+        Tracer::record(EventKind::Send, index, target.index, data.size());
+        if (verbose) std::cout << "Data sent from " << id << " to " << target.id << ": " << data << "\n";
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
+    std::string traceFile;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--verbose] [--trace <trace_file>]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Optional binary trace of every operation, see cpp-process/trace_dump
+    if (!traceFile.empty()) {
+        if (!NETSIM_TRACE) {
+            std::cerr << "Tracing is disabled in this build, ignoring --trace" << std::endl;
+        } else if (!netsim::trace::Session::instance().start(traceFile)) {
+            std::cerr << "Failed to open trace file: " << traceFile << std::endl;
+            return 1;
+        }
+    }
+    netsim::profile::Profiler::instance().enableFromEnvironment("NETSIM_PROFILE");
+
     std::cout << "Network Simulation in C++" << std::endl;
     std::cout << "-------------------------" << std::endl;
 
     // Create network nodes
     std::vector<NetworkNode> nodes = {
-        NetworkNode("server-1", "server", "192.168.1.1"),
-        NetworkNode("router-1", "router", "192.168.1.254"),
-        NetworkNode("client-1", "client", "192.168.1.100"),
-        NetworkNode("client-2", "client", "192.168.1.101")
+        NetworkNode("server-1", "server", "192.168.1.1", 0),
+        NetworkNode("router-1", "router", "192.168.1.254", 1),
+        NetworkNode("client-1", "client", "192.168.1.100", 2),
+        NetworkNode("client-2", "client", "192.168.1.101", 3)
     };
 
     // Activate nodes
@@ -56,15 +98,23 @@ int main() {
     std::cout << "\nSimulating network traffic:" << std::endl;
     
     // Simulate some network traffic
-    nodes[2].sendData(nodes[0], "GET /api/data");
-    nodes[0].sendData(nodes[2], "200 OK: {\"data\": [1, 2, 3]}");
-    nodes[3].sendData(nodes[0], "POST /api/update");
-    nodes[0].sendData(nodes[3], "201 Created");
+    {
+        NETSIM_PROFILE_SCOPE("traffic");
+        nodes[2].sendData(nodes[0], "GET /api/data");
+        nodes[0].sendData(nodes[2], "200 OK: {\"data\": [1, 2, 3]}");
+        nodes[3].sendData(nodes[0], "POST /api/update");
+        nodes[0].sendData(nodes[3], "201 Created");
 
-    // Deactivate a node and try to send data
-    nodes[0].deactivate();
-    nodes[2].sendData(nodes[0], "GET /api/status");
+        // Deactivate a node and try to send data
+        nodes[0].deactivate();
+        nodes[2].sendData(nodes[0], "GET /api/status");
+    }
 
+    netsim::trace::Session::instance().stop();
     std::cout << "\nNetwork simulation completed" << std::endl;
+
+    if (netsim::profile::isEnabled()) {
+        netsim::profile::Profiler::instance().print(stderr, "network simulation");
+    }
     return 0;
 }